@@ -3,6 +3,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #define MAX_BOOKS 1000
 #define MAX_USERS 100
@@ -11,6 +18,27 @@
 #define MAX_AUTHOR_LENGTH 100
 #define HASH_SIZE 101
 #define BUFFER_SIZE 512  // Buffer size
+#define MINHASH_SIZE 32  // MinHash signature length per user
+#define LSH_BANDS 16     // LSH bands (MINHASH_SIZE = LSH_BANDS * LSH_ROWS); with
+#define LSH_ROWS 2       // 2 rows the banding midpoint (1/16)^(1/2) = 0.25 sits
+                         // just below SIMILARITY_THRESHOLD
+#define LSH_BUCKETS 211  // Buckets per band
+#define MAX_SIMILAR_USERS 5
+#define SIMILARITY_THRESHOLD 0.3f  // Minimum estimated Jaccard similarity
+#define OUTPUT_BUFFER_SIZE 65536  // Reusable output buffer size
+#define OUTPUT_IOV_COUNT 64       // Segments gathered per writev flush
+#define OUTPUT_TABLE 0            // Fixed-width table (interactive default)
+#define OUTPUT_TSV 1              // Tab-separated values
+#define OUTPUT_JSONL 2            // JSON Lines
+#define PREF_SLAB_INTS 1024       // Preference slab per user (>= MAX_BOOKS, one 4 KiB page)
+#define STORE_MAGIC "BOOKSTR3"    // Out-of-core store file signature
+#define STORE_OPENED 0            // Store mapped and its users restored
+#define STORE_MISSING 1           // No store file yet
+#define STORE_STALE 2             // books.csv changed; rebuild keeping the users
+#define STORE_UNUSABLE 3          // Damaged or from another build; left untouched
+#define SOURCE_GRAPH 0            // Candidate reached through the book graph
+#define SOURCE_SIMILAR 1          // Candidate taken from a similar user
+#define SOURCE_PREFERRED 2        // Book the user already prefers
 //  book
 typedef struct Book {
     int id;
@@ -25,8 +53,10 @@ typedef struct Book {
 typedef struct User {
     int id;
     char name[MAX_NAME_LENGTH];
-    int preferredBooks[MAX_BOOKS];
+    int* preferredBooks;  // Slab of PREF_SLAB_INTS in preferenceSlabs
+    int* preferredIds;    // Book IDs of preferredBooks, in preferenceIdArena
     int prefCount;
+    unsigned int signature[MINHASH_SIZE];  // MinHash of preferredBooks
 } User;
 
 //hash table node
@@ -35,64 +65,299 @@ typedef struct HashNode {
     struct HashNode* next;
 } HashNode;
 
+// LSH bucket node (points at a user stored in the hash table)
+typedef struct LSHNode {
+    User* user;
+    struct LSHNode* next;
+} LSHNode;
+
 // adjacency list node
 typedef struct AdjListNode {
     int dest;
     struct AdjListNode* next;
 } AdjListNode;
 
+// Buffered result writer: formatted bytes accumulate in buffer, constant
+// text (headers, rules) is referenced in place, and both are flushed together
+// with a single writev
+typedef struct OutputWriter {
+    int format;
+    int fd;         // Listings go here; stdio keeps prompts and diagnostics
+    char buffer[OUTPUT_BUFFER_SIZE];
+    int used;       // Bytes used in buffer
+    int segStart;   // Start of the buffer segment not yet added to iov
+    struct iovec iov[OUTPUT_IOV_COUNT];
+    int iovCount;
+} OutputWriter;
+
+// Books sharing a genre and author, as stored. Groups are ordered by genre
+// and author and their books are numbered consecutively in that order, so a
+// book's neighbours are its genre's index range plus its author's groups.
+typedef struct BookGroup {
+    char genre[MAX_GENRE_LENGTH];
+    int genreFirst;   // First group of the genre
+    int authorFirst;  // Groups by the same author are
+    int authorEnd;    // byAuthor[authorFirst..authorEnd)
+    long start;       // First book index
+    long count;       // Books in the group
+    long genreStart;  // Books of the same genre are [genreStart, genreEnd)
+    long genreEnd;
+} BookGroup;
+
+// Store index entry mapping a book ID to its row
+typedef struct BookIdEntry {
+    int id;
+    int index;
+} BookIdEntry;
+
 // Structure to represent a graph
 typedef struct Graph {
     int numBooks;
-    AdjListNode** adjLists;  // Array of adjacency lists
+    AdjListNode** adjLists;  // Array of adjacency lists (in-memory mode)
+    BookGroup* groups;       // Group table (store mode); edges are implied
+    int* byAuthor;           // Group indexes ordered by author (store mode)
+    int numGroups;
 } Graph;
 
+// Out-of-core store file header. Sections are page-aligned and ordered hot to
+// cold: the group table and author order (read on every BFS step), the book
+// ID index, book rows, then the user records and one preference page per
+// user slot. The sizes and capacities of the writing build are recorded so a
+// mismatched build rejects the file instead of misreading it.
+typedef struct StoreHeader {
+    char magic[8];
+    long pageSize;
+    long bookSize;         // sizeof(Book)
+    long groupSize;        // sizeof(BookGroup)
+    long userSectionSize;  // sizeof(UserSection)
+    long slabInts;         // PREF_SLAB_INTS
+    long userCapacity;     // MAX_USERS
+    long bookCount;
+    long groupCount;
+    long groupsOffset;
+    long byAuthorOffset;
+    long idsOffset;        // BookIdEntry array sorted by ID
+    long booksOffset;
+    long usersOffset;
+    long slabsOffset;
+    long fileSize;
+    long csvSize;          // Source CSV, to detect a stale store
+    long csvMtime;         // Nanoseconds
+} StoreHeader;
+
+// Persistent user; its preferred book IDs are the slab with the same slot
+typedef struct UserRecord {
+    int id;
+    int prefCount;
+    char name[MAX_NAME_LENGTH];
+} UserRecord;
+
+// Store section holding every persisted user
+typedef struct UserSection {
+    int userCount;
+    UserRecord users[MAX_USERS];
+} UserSection;
+
+// Mappings of an opened store
+typedef struct BookStore {
+    char* base;          // Private mapping of header, groups, ID index and books
+    long baseSize;
+    char* shared;        // Shared mapping of user records and preference slabs
+    long sharedSize;
+    BookGroup* groups;   // Sorted by genre, then author
+    int groupCount;
+    BookIdEntry* ids;    // Sorted by ID; NULL in memory mode
+    UserSection* users;  // NULL in memory mode
+} BookStore;
+
+// Books sharing a genre and author while a store is being built
+typedef struct StoreGroup {
+    char genre[MAX_GENRE_LENGTH];
+    char author[MAX_AUTHOR_LENGTH];
+    long count;        // Books in the group
+    long start;        // First book index after renumbering
+    long fill;         // Books placed so far
+    long genreStart;   // Books of the same genre are [genreStart, genreEnd)
+    long genreEnd;
+    int genreFirst;    // First group of the genre
+    int authorFirst;   // Groups by the same author are
+    int authorEnd;     // byAuthor[authorFirst..authorEnd)
+} StoreGroup;
+
+// Open-addressing index of groups by genre and author
+typedef struct GroupTable {
+    StoreGroup* groups;
+    int count;
+    int capacity;
+    int* slots;        // Group index + 1, or 0 when empty
+    int slotCount;     // Power of two
+} GroupTable;
+
 // Global arrays and variables
-Book books[MAX_BOOKS];
+Book bookArray[MAX_BOOKS];
+Book* books = bookArray;  // Points into the store mapping in store mode
 int bookCount = 0;
 
+int preferenceSlabs[MAX_USERS * PREF_SLAB_INTS];
+int preferenceIdSlabs[MAX_USERS * PREF_SLAB_INTS];
+int* preferenceIdArena = preferenceIdSlabs;  // Points into the store mapping in store mode
+
+BookStore store;
+StoreGroup* authorOrderGroups;  // Groups array seen by compare_group_author
+
 HashNode* hashTable[HASH_SIZE];
 int userCount = 0;
 
+LSHNode* lshTable[LSH_BANDS][LSH_BUCKETS];
+
+OutputWriter writer;
+
+static const char BOOK_HEADER[] =
+    "ID    Title                                    Author                    Genre           Rating  Popularity\n";
+static const char BOOK_RULE[] =
+    "--------------------------------------------------------------------------------------------------------------\n";
+static const char BOOK_TSV_HEADER[] = "id\ttitle\tauthor\tgenre\trating\tpopularity\n";
+static const char USER_HEADER[] =
+    "ID    Name                      Preferred Books                         \n";
+static const char USER_RULE[] =
+    "--------------------------------------------------------------------------------------------------\n";
+static const char USER_TSV_HEADER[] = "id\tname\tpreferred_books\n";
+
 // Function
 void initializeHashTable();
 int hashFunction(int userId);
 void insertUser(User user);
 User* searchUser(int userId);
+unsigned int minHashValue(int bookIndex, int k);
+void initializeSignature(User* user);
+void addPreferredBook(User* user, int bookIndex);
+int lshBandBucket(User* user, int band);
+void lshInsertUser(User* user);
+void lshRemoveUser(User* user);
+void addPreferenceToStoredUser(User* user, int bookIndex);
+float preferenceJaccard(User* a, User* b);
+int findSimilarUsers(User* user, User* similar[], int maxSimilar);
+void freeLSHIndex();
 void loadBooksFromCSV(const char* filename);
+int parseBookLine(char* buffer, Book* newBook);
 void trim(char* str);
 Graph* createGraph(int numBooks);
 AdjListNode* createAdjListNode(int dest);
 void addEdge(Graph* graph, int src, int dest);
 void buildBookGraph(Graph* graph);
+int setOutputFormat(OutputWriter* w, const char* name);
+void writerCloseSegment(OutputWriter* w);
+void writerFlush(OutputWriter* w);
+void writerReserve(OutputWriter* w, int n);
+void writerPutStatic(OutputWriter* w, const char* s, int len);
+void writerPutRaw(OutputWriter* w, const char* s, int len);
+void writerPutString(OutputWriter* w, const char* s);
+void writerPad(OutputWriter* w, int written, int width);
+void writerPutInt(OutputWriter* w, int value, int width);
+void writerPutRating(OutputWriter* w, float value, int width);
+void writeBookHeader(OutputWriter* w, const char* title);
+void writeBookRow(OutputWriter* w, const Book* book);
+void writeUserHeader(OutputWriter* w);
+void writeUserRow(OutputWriter* w, const User* user);
+void writeRule(OutputWriter* w, const char* rule, int len);
 void displayBooks();
+int findBookIndex(int bookId);
+int genreExists(const char* genre);
 void addUser();
+void addUserPreference();
 void displayUsers();
 void displayPopularBooks();
 void displayUnderratedBooks();
 void recommendBooks(User* user, Graph* graph);
 void bfs_graph(Graph* graph, int startId, int visited[], int recommendations[], int* recCount);
+int findBookGroup(Graph* graph, int book);
+void addStoreNeighbours(Graph* graph, int book, char* expanded, int visited[], int queue[], int* rear);
 int compare_popularity_desc(const void* a, const void* b);
 void freeGraph(Graph* graph);
+long alignToPage(long size, long pageSize);
+unsigned int groupHash(const char* genre, const char* author);
+int findGroup(GroupTable* table, const Book* book, int create);
+void rebuildGroupSlots(GroupTable* table);
+int compare_group_locality(const void* a, const void* b);
+int compare_group_author(const void* a, const void* b);
+int compare_book_id(const void* a, const void* b);
+int buildStore(const char* path, const char* csvPath, int keepUsers);
+int countBookGroups(FILE* file, GroupTable* table, long* total);
+void orderBookGroups(GroupTable* table, int* byAuthor);
+int writeStoreFile(const char* path, FILE* file, GroupTable* table, int* byAuthor, long total,
+                   const struct stat* csvStat, const char* usersFrom);
+int copyStoreUsers(const char* path, char* users, char* slabs);
+int validateStoreHeader(const StoreHeader* header, long fileSize);
+int checkStoreSections(const StoreHeader* header, const char* base);
+int openStore(const char* path, const char* csvPath, Graph** graphOut);
+int restoreUsers();
+void saveUserRecord(User* user);
+void closeStore();
 
 // Main Function
-int main() {
+int main(int argc, char* argv[]) {
     int choice;
     Graph* graph = NULL;
+    const char* storePath = NULL;
 
-    // Initialize hash table
-    initializeHashTable();
+    // Parse command line options
+    writer.format = OUTPUT_TABLE;
+    for(int i=1;i<argc;i++) {
+        if(strcmp(argv[i], "--format") == 0 && i+1 < argc) {
+            if(!setOutputFormat(&writer, argv[++i])) {
+                printf("Unknown output format \"%s\" (expected table, tsv or jsonl).\n", argv[i]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--store") == 0 && i+1 < argc) {
+            storePath = argv[++i];
+        } else {
+            printf("Usage: %s [--format table|tsv|jsonl] [--store FILE]\n", argv[0]);
+            return 1;
+        }
+    }
 
-    // Load books from CSV
-    loadBooksFromCSV("books.csv");
-    if(bookCount == 0){
-        printf("No books loaded. Please check the CSV file.\n");
-        return 1;
+    // Batch formats keep stdout for listings only: move prompts and
+    // diagnostics printed through stdio to stderr
+    writer.fd = STDOUT_FILENO;
+    if(writer.format != OUTPUT_TABLE) {
+        writer.fd = dup(STDOUT_FILENO);
+        if(writer.fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            printf("Could not separate listings from prompts.\n");
+            return 1;
+        }
     }
 
-    // Create and build the graph
-    graph = createGraph(bookCount);
-    buildBookGraph(graph);
+    // Initialize hash table and LSH index
+    initializeHashTable();
+
+    if(storePath != NULL) {
+        // Reuse the store, or stream books.csv into a new one. A stale
+        // store's users are carried over; an unusable one is never replaced.
+        int status = openStore(storePath, "books.csv", &graph);
+        if(status == STORE_UNUSABLE) {
+            printf("Leaving %s untouched. Move it aside to build a new store from books.csv.\n", storePath);
+            return 1;
+        }
+        if(status != STORE_OPENED) {
+            if(!buildStore(storePath, "books.csv", status == STORE_STALE)
+               || openStore(storePath, "books.csv", &graph) != STORE_OPENED) {
+                printf("Could not build book store %s.\n", storePath);
+                return 1;
+            }
+        }
+        printf("Opened book store %s with %d books and %d users\n", storePath, bookCount, userCount);
+    } else {
+        // Load books from CSV
+        loadBooksFromCSV("books.csv");
+        if(bookCount == 0){
+            printf("No books loaded. Please check the CSV file.\n");
+            return 1;
+        }
+
+        // Create and build the graph
+        graph = createGraph(bookCount);
+        buildBookGraph(graph);
+    }
 
     // Main Menu Loop
     while (1) {
@@ -103,7 +368,8 @@ int main() {
         printf("4. Display Most Popular Books\n");
         printf("5. Display Most Underrated Books\n");
         printf("6. Recommend Books to a User\n");
-        printf("7. Exit\n");
+        printf("7. Add Preferred Book to a User\n");
+        printf("8. Exit\n");
         printf("Enter your choice: ");
         if(scanf("%d", &choice)!=1){
             printf("Invalid input! Please enter a number.\n");
@@ -146,6 +412,9 @@ int main() {
                 break;
             }
             case 7:
+                addUserPreference();
+                break;
+            case 8:
                 printf("Exiting...\n");
                 freeGraph(graph);
                 // Free hash table memory
@@ -157,6 +426,8 @@ int main() {
                         free(temp);
                     }
                 }
+                freeLSHIndex();
+                closeStore();
                 exit(0);
             default:
                 printf("Invalid choice! Please try again.\n");
@@ -171,6 +442,11 @@ void initializeHashTable() {
     for(int i=0;i<HASH_SIZE;i++) {
         hashTable[i] = NULL;
     }
+    for(int b=0;b<LSH_BANDS;b++) {
+        for(int i=0;i<LSH_BUCKETS;i++) {
+            lshTable[b][i] = NULL;
+        }
+    }
 }
 
 // Simple hash function for user IDs
@@ -189,6 +465,8 @@ void insertUser(User user) {
     newNode->user = user;
     newNode->next = hashTable[hashIndex];
     hashTable[hashIndex] = newNode;
+    // Index the stored copy so similarity queries can find it
+    lshInsertUser(&(newNode->user));
 }
 
 // Function to search for a user in the hash table
@@ -203,6 +481,171 @@ User* searchUser(int userId) {
     return NULL;
 }
 
+// k-th MinHash function: a seeded integer mixer over the book index
+unsigned int minHashValue(int bookIndex, int k) {
+    unsigned int x = (unsigned int)bookIndex ^ ((unsigned int)(k + 1) * 0x9E3779B9u);
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+// Function to reset a user's signature to the empty set
+void initializeSignature(User* user) {
+    for(int k=0;k<MINHASH_SIZE;k++) {
+        user->signature[k] = 0xFFFFFFFFu;
+    }
+}
+
+// Function to add a book to a user's preferences and fold it into the signature
+void addPreferredBook(User* user, int bookIndex) {
+    user->preferredIds[user->prefCount] = books[bookIndex].id;
+    user->preferredBooks[user->prefCount++] = bookIndex;
+    books[bookIndex].popularity += 1; // Increment popularity
+    for(int k=0;k<MINHASH_SIZE;k++) {
+        unsigned int h = minHashValue(bookIndex, k);
+        if(h < user->signature[k])
+            user->signature[k] = h;
+    }
+}
+
+// Function to hash one band of a user's signature to a bucket (FNV-1a)
+int lshBandBucket(User* user, int band) {
+    unsigned int h = 2166136261u;
+    for(int r=0;r<LSH_ROWS;r++) {
+        h ^= user->signature[band * LSH_ROWS + r];
+        h *= 16777619u;
+    }
+    return h % LSH_BUCKETS;
+}
+
+// Function to add a user to one bucket in every band
+void lshInsertUser(User* user) {
+    if(user->prefCount == 0)
+        return; // Empty sets carry no similarity signal
+    for(int b=0;b<LSH_BANDS;b++) {
+        int bucket = lshBandBucket(user, b);
+        LSHNode* newNode = (LSHNode*) malloc(sizeof(LSHNode));
+        if(newNode == NULL){
+            printf("Memory allocation failed!\n");
+            return;
+        }
+        newNode->user = user;
+        newNode->next = lshTable[b][bucket];
+        lshTable[b][bucket] = newNode;
+    }
+}
+
+// Function to unlink a user from its bucket in every band. Must be called
+// before the user's signature changes.
+void lshRemoveUser(User* user) {
+    for(int b=0;b<LSH_BANDS;b++) {
+        LSHNode** link = &lshTable[b][lshBandBucket(user, b)];
+        while(*link != NULL) {
+            if((*link)->user == user) {
+                LSHNode* temp = *link;
+                *link = temp->next;
+                free(temp);
+                break;
+            }
+            link = &(*link)->next;
+        }
+    }
+}
+
+// Function to add a book to a user already in the hash table, moving the
+// user to the LSH buckets of its updated signature
+void addPreferenceToStoredUser(User* user, int bookIndex) {
+    lshRemoveUser(user);
+    addPreferredBook(user, bookIndex);
+    lshInsertUser(user);
+    saveUserRecord(user);
+}
+
+// Function to compute the exact Jaccard similarity of two preference sets
+float preferenceJaccard(User* a, User* b) {
+    int common = 0;
+    for(int i=0;i<a->prefCount;i++) {
+        for(int j=0;j<b->prefCount;j++) {
+            if(a->preferredBooks[i] == b->preferredBooks[j]) {
+                common++;
+                break;
+            }
+        }
+    }
+    int unionSize = a->prefCount + b->prefCount - common;
+    return unionSize == 0 ? 0.0f : (float)common / unionSize;
+}
+
+// Function to find users with similar preferences. LSH limits the search to
+// candidates sharing at least one identical band; those are then checked and
+// ranked by their exact Jaccard similarity, which avoids the noise of a
+// 32-row estimate near the threshold. Returns the number of users found.
+int findSimilarUsers(User* user, User* similar[], int maxSimilar) {
+    User* candidates[MAX_USERS];
+    float scores[MAX_USERS];
+    int candidateCount = 0;
+    if(user->prefCount == 0)
+        return 0;
+
+    for(int b=0;b<LSH_BANDS;b++) {
+        LSHNode* node = lshTable[b][lshBandBucket(user, b)];
+        while(node != NULL) {
+            User* other = node->user;
+            node = node->next;
+            if(other == user || other->id == user->id)
+                continue;
+            // Skip bucket collisions whose band does not actually match
+            if(memcmp(&other->signature[b * LSH_ROWS], &user->signature[b * LSH_ROWS],
+                      LSH_ROWS * sizeof(unsigned int)) != 0)
+                continue;
+            int seen = 0;
+            for(int i=0;i<candidateCount;i++) {
+                if(candidates[i] == other) {
+                    seen = 1;
+                    break;
+                }
+            }
+            if(seen || candidateCount >= MAX_USERS)
+                continue;
+            float score = preferenceJaccard(user, other);
+            if(score < SIMILARITY_THRESHOLD)
+                continue;
+            // Insertion sort by descending similarity
+            int pos = candidateCount++;
+            while(pos > 0 && scores[pos-1] < score) {
+                candidates[pos] = candidates[pos-1];
+                scores[pos] = scores[pos-1];
+                pos--;
+            }
+            candidates[pos] = other;
+            scores[pos] = score;
+        }
+    }
+
+    int count = candidateCount < maxSimilar ? candidateCount : maxSimilar;
+    for(int i=0;i<count;i++)
+        similar[i] = candidates[i];
+    return count;
+}
+
+// Function to free the LSH bucket chains
+void freeLSHIndex() {
+    for(int b=0;b<LSH_BANDS;b++) {
+        for(int i=0;i<LSH_BUCKETS;i++) {
+            LSHNode* node = lshTable[b][i];
+            while(node != NULL) {
+                LSHNode* temp = node;
+                node = node->next;
+                free(temp);
+            }
+            lshTable[b][i] = NULL;
+        }
+    }
+}
+
 // Function to load books from a CSV file
 void loadBooksFromCSV(const char* filename) {
     FILE* file = fopen(filename, "r");
@@ -223,43 +666,11 @@ void loadBooksFromCSV(const char* filename) {
             printf("Maximum book limit reached. Some books may not be loaded.\n");
             break;
         }
-        // Parse CSV line
-        char* token;
-        int field = 0;
         Book newBook;
-        token = strtok(buffer, ",");
-        while(token != NULL){
-            trim(token);
-            switch(field){
-                case 0:
-                    newBook.id = atoi(token);
-                    break;
-                case 1:
-                    strncpy(newBook.title, token, MAX_NAME_LENGTH);
-                    newBook.title[MAX_NAME_LENGTH-1] = '\0';
-                    break;
-                case 2:
-                    strncpy(newBook.author, token, MAX_AUTHOR_LENGTH);
-                    newBook.author[MAX_AUTHOR_LENGTH-1] = '\0';
-                    break;
-                case 3:
-                    strncpy(newBook.genre, token, MAX_GENRE_LENGTH);
-                    newBook.genre[MAX_GENRE_LENGTH-1] = '\0';
-                    break;
-                case 4:
-                    newBook.rating = atof(token); // Parse rating as float
-                    break;
-                default:
-                    break;
-            }
-            field++;
-            token = strtok(NULL, ",");
-        }
-        if(field < 5){
+        if(!parseBookLine(buffer, &newBook)){
             printf("Incomplete data at line %d. Skipping.\n", line);
             continue;
         }
-        newBook.popularity = 0; // Initialize popularity
         books[bookCount++] = newBook;
     }
 
@@ -267,6 +678,42 @@ void loadBooksFromCSV(const char* filename) {
     printf("Loaded %d books from %s\n", bookCount, filename);
 }
 
+// Function to parse one CSV line into a book (returns 0 if fields are missing)
+int parseBookLine(char* buffer, Book* newBook) {
+    char* token;
+    int field = 0;
+    token = strtok(buffer, ",");
+    while(token != NULL){
+        trim(token);
+        switch(field){
+            case 0:
+                newBook->id = atoi(token);
+                break;
+            case 1:
+                strncpy(newBook->title, token, MAX_NAME_LENGTH);
+                newBook->title[MAX_NAME_LENGTH-1] = '\0';
+                break;
+            case 2:
+                strncpy(newBook->author, token, MAX_AUTHOR_LENGTH);
+                newBook->author[MAX_AUTHOR_LENGTH-1] = '\0';
+                break;
+            case 3:
+                strncpy(newBook->genre, token, MAX_GENRE_LENGTH);
+                newBook->genre[MAX_GENRE_LENGTH-1] = '\0';
+                break;
+            case 4:
+                newBook->rating = atof(token); // Parse rating as float
+                break;
+            default:
+                break;
+        }
+        field++;
+        token = strtok(NULL, ",");
+    }
+    newBook->popularity = 0; // Initialize popularity
+    return field >= 5;
+}
+
 // Function to trim whitespace and newline characters
 void trim(char* str) {
     int len = strlen(str);
@@ -288,6 +735,9 @@ Graph* createGraph(int numBooks) {
         exit(1);
     }
     graph->numBooks = numBooks;
+    graph->groups = NULL;
+    graph->byAuthor = NULL;
+    graph->numGroups = 0;
     graph->adjLists = (AdjListNode**) malloc(numBooks * sizeof(AdjListNode*));
     if(graph->adjLists == NULL){
         printf("Memory allocation failed!\n");
@@ -336,25 +786,375 @@ void buildBookGraph(Graph* graph) {
     printf("Book graph built based on shared authors and genres.\n");
 }
 
+// Function to select the listing format by name
+int setOutputFormat(OutputWriter* w, const char* name) {
+    if(strcmp(name, "table") == 0)
+        w->format = OUTPUT_TABLE;
+    else if(strcmp(name, "tsv") == 0)
+        w->format = OUTPUT_TSV;
+    else if(strcmp(name, "jsonl") == 0)
+        w->format = OUTPUT_JSONL;
+    else
+        return 0;
+    return 1;
+}
+
+// Function to add the pending part of the buffer as an iov segment
+void writerCloseSegment(OutputWriter* w) {
+    if(w->used > w->segStart) {
+        w->iov[w->iovCount].iov_base = w->buffer + w->segStart;
+        w->iov[w->iovCount].iov_len = w->used - w->segStart;
+        w->iovCount++;
+        w->segStart = w->used;
+    }
+}
+
+// Function to write all gathered segments to the listing fd
+void writerFlush(OutputWriter* w) {
+    writerCloseSegment(w);
+    fflush(stdout); // Keep ordering with prompts printed through stdio
+    struct iovec* iov = w->iov;
+    int count = w->iovCount;
+    while(count > 0) {
+        ssize_t written = writev(w->fd, iov, count);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        // Skip fully written segments and advance into a partial one
+        while(count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if(count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    w->used = 0;
+    w->segStart = 0;
+    w->iovCount = 0;
+}
+
+// Function to make room for n more bytes in the buffer
+void writerReserve(OutputWriter* w, int n) {
+    if(w->used + n > OUTPUT_BUFFER_SIZE)
+        writerFlush(w);
+}
+
+// Function to queue constant text without copying it
+void writerPutStatic(OutputWriter* w, const char* s, int len) {
+    if(w->iovCount >= OUTPUT_IOV_COUNT - 2)
+        writerFlush(w);
+    writerCloseSegment(w);
+    w->iov[w->iovCount].iov_base = (void*)s;
+    w->iov[w->iovCount].iov_len = len;
+    w->iovCount++;
+}
+
+// Function to copy bytes into the buffer unchanged
+void writerPutRaw(OutputWriter* w, const char* s, int len) {
+    writerReserve(w, len);
+    memcpy(w->buffer + w->used, s, len);
+    w->used += len;
+}
+
+// Function to copy a field, escaping it for the current format
+void writerPutString(OutputWriter* w, const char* s) {
+    int len = strlen(s);
+    if(w->format != OUTPUT_JSONL) {
+        writerReserve(w, len);
+        char* out = w->buffer + w->used;
+        for(int i=0;i<len;i++) {
+            char c = s[i];
+            // Tabs and newlines would split a TSV row
+            if(w->format == OUTPUT_TSV && (c == '\t' || c == '\n' || c == '\r'))
+                c = ' ';
+            out[i] = c;
+        }
+        w->used += len;
+        return;
+    }
+    static const char hex[] = "0123456789abcdef";
+    writerReserve(w, len * 6 + 2);
+    char* out = w->buffer + w->used;
+    *out++ = '"';
+    for(int i=0;i<len;i++) {
+        unsigned char c = s[i];
+        if(c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = c;
+        } else if(c < 0x20) {
+            *out++ = '\\';
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 0xF];
+        } else {
+            *out++ = c;
+        }
+    }
+    *out++ = '"';
+    w->used = out - w->buffer;
+}
+
+// Function to left-justify a field by padding with spaces (like "%-*s")
+void writerPad(OutputWriter* w, int written, int width) {
+    if(written >= width)
+        return;
+    writerReserve(w, width - written);
+    memset(w->buffer + w->used, ' ', width - written);
+    w->used += width - written;
+}
+
+// Function to format an integer, left-justified to width (like "%-*d")
+void writerPutInt(OutputWriter* w, int value, int width) {
+    char digits[12];
+    int n = 0;
+    unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v != 0);
+    writerReserve(w, n + 1);
+    int len = 0;
+    if(value < 0)
+        w->buffer[w->used + len++] = '-';
+    while(n > 0)
+        w->buffer[w->used + len++] = digits[--n];
+    w->used += len;
+    writerPad(w, len, width);
+}
+
+// Function to format a rating with one decimal, left-justified to width
+// (like "%-*.1f", including round-half-to-even on exact ties)
+void writerPutRating(OutputWriter* w, float value, int width) {
+    double d = value;
+    if(d != d || d > 1e9 || d < -1e9) {
+        // Out of the fast path's range; these never occur in real catalogs
+        char tmp[64];
+        int len;
+        if(w->format == OUTPUT_JSONL)
+            len = snprintf(tmp, sizeof(tmp), "null");
+        else
+            len = snprintf(tmp, sizeof(tmp), "%.1f", d);
+        writerPutRaw(w, tmp, len);
+        writerPad(w, len, width);
+        return;
+    }
+    int negative = d < 0 || (d == 0 && 1 / d < 0);
+    if(negative)
+        d = -d;
+    long tenths = (long)(d * 10);
+    double frac = d * 10 - tenths;
+    if(frac > 0.5 || (frac == 0.5 && (tenths & 1)))
+        tenths++;
+    // Format into a local field first so a flush cannot split the length
+    char field[16];
+    char digits[12];
+    int n = 0;
+    long whole = tenths / 10;
+    do {
+        digits[n++] = '0' + whole % 10;
+        whole /= 10;
+    } while(whole != 0);
+    int len = 0;
+    if(negative)
+        field[len++] = '-';
+    while(n > 0)
+        field[len++] = digits[--n];
+    field[len++] = '.';
+    field[len++] = '0' + tenths % 10;
+    writerPutRaw(w, field, len);
+    writerPad(w, len, width);
+}
+
+// Function to write the heading of a book listing
+void writeBookHeader(OutputWriter* w, const char* title) {
+    if(w->format == OUTPUT_TABLE) {
+        writerPutRaw(w, "\n--- ", 5);
+        writerPutString(w, title);
+        writerPutRaw(w, " ---\n", 5);
+        writerPutStatic(w, BOOK_HEADER, sizeof(BOOK_HEADER) - 1);
+        writerPutStatic(w, BOOK_RULE, sizeof(BOOK_RULE) - 1);
+    } else if(w->format == OUTPUT_TSV) {
+        writerPutStatic(w, BOOK_TSV_HEADER, sizeof(BOOK_TSV_HEADER) - 1);
+    }
+}
+
+// Function to write one book in the current format
+void writeBookRow(OutputWriter* w, const Book* book) {
+    if(w->format == OUTPUT_TABLE) {
+        writerPutInt(w, book->id, 5);
+        writerPutRaw(w, " ", 1);
+        writerPutString(w, book->title);
+        writerPad(w, strlen(book->title), 40);
+        writerPutRaw(w, " ", 1);
+        writerPutString(w, book->author);
+        writerPad(w, strlen(book->author), 25);
+        writerPutRaw(w, " ", 1);
+        writerPutString(w, book->genre);
+        writerPad(w, strlen(book->genre), 15);
+        writerPutRaw(w, " ", 1);
+        writerPutRating(w, book->rating, 7);
+        writerPutRaw(w, " ", 1);
+        writerPutInt(w, book->popularity, 10);
+        writerPutRaw(w, "\n", 1);
+    } else if(w->format == OUTPUT_TSV) {
+        writerPutInt(w, book->id, 0);
+        writerPutRaw(w, "\t", 1);
+        writerPutString(w, book->title);
+        writerPutRaw(w, "\t", 1);
+        writerPutString(w, book->author);
+        writerPutRaw(w, "\t", 1);
+        writerPutString(w, book->genre);
+        writerPutRaw(w, "\t", 1);
+        writerPutRating(w, book->rating, 0);
+        writerPutRaw(w, "\t", 1);
+        writerPutInt(w, book->popularity, 0);
+        writerPutRaw(w, "\n", 1);
+    } else {
+        writerPutRaw(w, "{\"id\":", 6);
+        writerPutInt(w, book->id, 0);
+        writerPutRaw(w, ",\"title\":", 9);
+        writerPutString(w, book->title);
+        writerPutRaw(w, ",\"author\":", 10);
+        writerPutString(w, book->author);
+        writerPutRaw(w, ",\"genre\":", 9);
+        writerPutString(w, book->genre);
+        writerPutRaw(w, ",\"rating\":", 10);
+        writerPutRating(w, book->rating, 0);
+        writerPutRaw(w, ",\"popularity\":", 14);
+        writerPutInt(w, book->popularity, 0);
+        writerPutRaw(w, "}\n", 2);
+    }
+}
+
+// Function to write the heading of the user listing
+void writeUserHeader(OutputWriter* w) {
+    if(w->format == OUTPUT_TABLE) {
+        writerPutRaw(w, "\n--- Users ---\n", 15);
+        writerPutStatic(w, USER_HEADER, sizeof(USER_HEADER) - 1);
+        writerPutStatic(w, USER_RULE, sizeof(USER_RULE) - 1);
+    } else if(w->format == OUTPUT_TSV) {
+        writerPutStatic(w, USER_TSV_HEADER, sizeof(USER_TSV_HEADER) - 1);
+    }
+}
+
+// Function to write one user and their preferred books in the current format
+void writeUserRow(OutputWriter* w, const User* user) {
+    if(w->format == OUTPUT_TABLE) {
+        writerPutInt(w, user->id, 5);
+        writerPutRaw(w, " ", 1);
+        writerPutString(w, user->name);
+        writerPad(w, strlen(user->name), 25);
+        writerPutRaw(w, " ", 1);
+        if(user->prefCount == 0)
+            writerPutRaw(w, "None", 4);
+        for(int j=0;j<user->prefCount;j++) {
+            if(j > 0)
+                writerPutRaw(w, ", ", 2);
+            writerPutRaw(w, "\"", 1);
+            writerPutString(w, books[user->preferredBooks[j]].title); // Only the table needs the row
+            writerPutRaw(w, "\" (ID: ", 7);
+            writerPutInt(w, user->preferredIds[j], 0);
+            writerPutRaw(w, ")", 1);
+        }
+        writerPutRaw(w, "\n", 1);
+    } else if(w->format == OUTPUT_TSV) {
+        writerPutInt(w, user->id, 0);
+        writerPutRaw(w, "\t", 1);
+        writerPutString(w, user->name);
+        writerPutRaw(w, "\t", 1);
+        for(int j=0;j<user->prefCount;j++) {
+            if(j > 0)
+                writerPutRaw(w, ",", 1);
+            writerPutInt(w, user->preferredIds[j], 0);
+        }
+        writerPutRaw(w, "\n", 1);
+    } else {
+        writerPutRaw(w, "{\"id\":", 6);
+        writerPutInt(w, user->id, 0);
+        writerPutRaw(w, ",\"name\":", 8);
+        writerPutString(w, user->name);
+        writerPutRaw(w, ",\"preferred_books\":[", 20);
+        for(int j=0;j<user->prefCount;j++) {
+            if(j > 0)
+                writerPutRaw(w, ",", 1);
+            writerPutInt(w, user->preferredIds[j], 0);
+        }
+        writerPutRaw(w, "]}\n", 3);
+    }
+}
+
+// Function to close a fixed-width table (no-op for TSV and JSON Lines)
+void writeRule(OutputWriter* w, const char* rule, int len) {
+    if(w->format == OUTPUT_TABLE)
+        writerPutStatic(w, rule, len);
+}
+
 // Function to display all books
 void displayBooks() {
     if(bookCount == 0) {
         printf("No books to display.\n");
         return;
     }
-    printf("\n--- All Books ---\n");
-    printf("%-5s %-40s %-25s %-15s %-7s %-10s\n", "ID", "Title", "Author", "Genre", "Rating", "Popularity");
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeBookHeader(&writer, "All Books");
+    for(int i=0;i<bookCount;i++) {
+        writeBookRow(&writer, &books[i]);
+    }
+    writeRule(&writer, BOOK_RULE, sizeof(BOOK_RULE) - 1);
+    writerFlush(&writer);
+}
+
+// Function to find a book's index by its ID (-1 if not found)
+int findBookIndex(int bookId) {
+    if(store.ids != NULL) {
+        // Store mode: binary search for the first entry with this ID
+        int low = 0, high = bookCount;
+        while(low < high) {
+            int mid = low + (high - low) / 2;
+            if(store.ids[mid].id < bookId)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if(low < bookCount && store.ids[low].id == bookId)
+            return store.ids[low].index;
+        return -1;
+    }
     for(int i=0;i<bookCount;i++) {
-        printf("%-5d %-40s %-25s %-15s %-7.1f %-10d\n",
-                books[i].id,
-                books[i].title,
-                books[i].author,
-                books[i].genre,
-                books[i].rating,
-                books[i].popularity);
+        if(books[i].id == bookId)
+            return i;
     }
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    return -1;
+}
+
+// Function to check whether any book has the given genre
+int genreExists(const char* genre) {
+    if(store.groups != NULL) {
+        // Store mode: groups are sorted by genre
+        int low = 0, high = store.groupCount;
+        while(low < high) {
+            int mid = low + (high - low) / 2;
+            int cmp = strcmp(store.groups[mid].genre, genre);
+            if(cmp == 0)
+                return 1;
+            if(cmp < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return 0;
+    }
+    for(int i=0;i<bookCount;i++) {
+        if(strcmp(books[i].genre, genre) == 0)
+            return 1;
+    }
+    return 0;
 }
 
 // Function to add a new user
@@ -375,7 +1175,10 @@ void addUser() {
     fgets(newUser.name, MAX_NAME_LENGTH, stdin);
     trim(newUser.name);
     newUser.prefCount = 0;
-    memset(newUser.preferredBooks, -1, sizeof(newUser.preferredBooks));
+    newUser.preferredBooks = preferenceSlabs + userCount * PREF_SLAB_INTS;
+    newUser.preferredIds = preferenceIdArena + userCount * PREF_SLAB_INTS;
+    memset(newUser.preferredIds, -1, PREF_SLAB_INTS * sizeof(int));
+    initializeSignature(&newUser);
 
     // Adding preferences
     printf("Do you want to add preferred books for %s? (1: Yes, 0: No): ", newUser.name);
@@ -395,16 +1198,8 @@ void addUser() {
         }
         getchar(); // Consume newline
         // Validate Book ID
-        int found = 0;
-        int bookIndex = -1;
-        for(int i=0;i<bookCount;i++) {
-            if(books[i].id == bookId){
-                found = 1;
-                bookIndex = i;
-                break;
-            }
-        }
-        if(!found){
+        int bookIndex = findBookIndex(bookId);
+        if(bookIndex == -1){
             printf("Book ID %d not found! Please try again.\n", bookId);
             continue;
         }
@@ -421,8 +1216,7 @@ void addUser() {
             continue;
         }
         // Add to preferences
-        newUser.preferredBooks[newUser.prefCount++] = bookIndex;
-        books[bookIndex].popularity += 1; // Increment popularity
+        addPreferredBook(&newUser, bookIndex);
         printf("Added \"%s\" to %s's preferences.\n", books[bookIndex].title, newUser.name);
 
         // Ask to add another preferred book
@@ -438,37 +1232,68 @@ void addUser() {
     // Insert user into hash table
     insertUser(newUser);
     userCount++;
+    saveUserRecord(&newUser);
     printf("User added successfully!\n");
 }
 
+// Function to add a preferred book to an existing user
+void addUserPreference() {
+    int userId;
+    printf("Enter User ID: ");
+    if(scanf("%d", &userId)!=1){
+        printf("Invalid input! Please enter a number.\n");
+        while(getchar()!='\n');
+        return;
+    }
+    getchar(); // Consume newline
+    User* user = searchUser(userId);
+    if(user == NULL){
+        printf("User not found!\n");
+        return;
+    }
+    if(user->prefCount >= MAX_BOOKS){
+        printf("Preference limit reached for %s.\n", user->name);
+        return;
+    }
+    int bookId;
+    printf("Enter Preferred Book ID: ");
+    if(scanf("%d", &bookId)!=1){
+        printf("Invalid input! Please enter a valid Book ID.\n");
+        while(getchar()!='\n');
+        return;
+    }
+    getchar(); // Consume newline
+    int bookIndex = findBookIndex(bookId);
+    if(bookIndex == -1){
+        printf("Book ID %d not found!\n", bookId);
+        return;
+    }
+    for(int i=0;i<user->prefCount;i++) {
+        if(user->preferredBooks[i] == bookIndex){
+            printf("Book \"%s\" is already in preferences.\n", books[bookIndex].title);
+            return;
+        }
+    }
+    addPreferenceToStoredUser(user, bookIndex);
+    printf("Added \"%s\" to %s's preferences.\n", books[bookIndex].title, user->name);
+}
+
 // Function to display all users
 void displayUsers() {
     if(userCount == 0){
         printf("\nNo users to display.\n");
         return;
     }
-    printf("\n--- Users ---\n");
-    printf("%-5s %-25s %-40s\n", "ID", "Name", "Preferred Books");
-    printf("--------------------------------------------------------------------------------------------------\n");
+    writeUserHeader(&writer);
     for(int i=0;i<HASH_SIZE;i++) {
         HashNode* node = hashTable[i];
         while(node != NULL){
-            printf("%-5d %-25s ", node->user.id, node->user.name);
-            if(node->user.prefCount == 0){
-                printf("None");
-            }
-            else{
-                for(int j=0;j<node->user.prefCount;j++) {
-                    printf("\"%s\" (ID: %d)", books[node->user.preferredBooks[j]].title, books[node->user.preferredBooks[j]].id);
-                    if(j != node->user.prefCount -1)
-                        printf(", ");
-                }
-            }
-            printf("\n");
+            writeUserRow(&writer, &node->user);
             node = node->next;
         }
     }
-    printf("--------------------------------------------------------------------------------------------------\n");
+    writeRule(&writer, USER_RULE, sizeof(USER_RULE) - 1);
+    writerFlush(&writer);
 }
 
 // Function to display most popular books
@@ -477,28 +1302,22 @@ void displayPopularBooks() {
         printf("No books available.\n");
         return;
     }
-    printf("\n--- Most Popular Books ---\n");
-    printf("%-5s %-40s %-25s %-15s %-7s %-10s\n", "ID", "Title", "Author", "Genre", "Rating", "Popularity");
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeBookHeader(&writer, "Most Popular Books");
     // Define a threshold for popularity, e.g., popularity > 5
     int threshold = 5;
     int found = 0;
     for(int i=0;i<bookCount;i++) {
         if(books[i].popularity > threshold){
-            printf("%-5d %-40s %-25s %-15s %-7.1f %-10d\n",
-                books[i].id,
-                books[i].title,
-                books[i].author,
-                books[i].genre,
-                books[i].rating,
-                books[i].popularity);
+            writeBookRow(&writer, &books[i]);
             found = 1;
         }
     }
+    writerFlush(&writer);
     if(!found){
         printf("No popular books found with popularity greater than %d.\n", threshold);
     }
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeRule(&writer, BOOK_RULE, sizeof(BOOK_RULE) - 1);
+    writerFlush(&writer);
 }
 
 // Function to display most underrated books
@@ -507,28 +1326,22 @@ void displayUnderratedBooks() {
         printf("No books available.\n");
         return;
     }
-    printf("\n--- Most Underrated Books ---\n");
-    printf("%-5s %-40s %-25s %-15s %-7s %-10s\n", "ID", "Title", "Author", "Genre", "Rating", "Popularity");
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeBookHeader(&writer, "Most Underrated Books");
     // Define a threshold for underrated, e.g., popularity <= 2
     int threshold = 2;
     int found = 0;
     for(int i=0;i<bookCount;i++) {
         if(books[i].popularity <= threshold){
-            printf("%-5d %-40s %-25s %-15s %-7.1f %-10d\n",
-                books[i].id,
-                books[i].title,
-                books[i].author,
-                books[i].genre,
-                books[i].rating,
-                books[i].popularity);
+            writeBookRow(&writer, &books[i]);
             found = 1;
         }
     }
+    writerFlush(&writer);
     if(!found){
         printf("No underrated books found with popularity less than or equal to %d.\n", threshold);
     }
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeRule(&writer, BOOK_RULE, sizeof(BOOK_RULE) - 1);
+    writerFlush(&writer);
 }
 
 // Function to recommend books to a user based on preferences and genre
@@ -548,14 +1361,7 @@ void recommendBooks(User* user, Graph* graph) {
     }
 
     // Validate the entered genre
-    int genreExists = 0;
-    for(int i=0;i<bookCount;i++) {
-        if(strcmp(books[i].genre, desiredGenre) == 0) {
-            genreExists = 1;
-            break;
-        }
-    }
-    if(!genreExists) {
+    if(!genreExists(desiredGenre)) {
         printf("Genre \"%s\" not found in the library. Please check the genre and try again.\n", desiredGenre);
         return;
     }
@@ -581,10 +1387,18 @@ void recommendBooks(User* user, Graph* graph) {
     else
         desiredPopularity = 0;
 
-    int visited[MAX_BOOKS];
-    for(int i=0;i<bookCount;i++) visited[i] = 0;
-
-    int recommendations[MAX_BOOKS];
+    // Traversal state is sized from the catalog, which may exceed MAX_BOOKS
+    // in store mode
+    int* scratch = (int*) malloc(bookCount * (2 * sizeof(int) + 1));
+    if(scratch == NULL) {
+        printf("Memory allocation failed!\n");
+        return;
+    }
+    int* visited = scratch;
+    int* recommendations = scratch + bookCount;
+    char* source = (char*)(scratch + 2 * bookCount);  // Where each candidate came from
+    memset(visited, 0, bookCount * sizeof(int));
+    memset(source, SOURCE_GRAPH, bookCount);
     int recCount = 0;
 
     // Traverse graph for each preferred book
@@ -593,39 +1407,39 @@ void recommendBooks(User* user, Graph* graph) {
         bfs_graph(graph, prefIndex, visited, recommendations, &recCount);
     }
 
-    // Remove duplicates and already preferred books
-    int uniqueRecommendations[MAX_BOOKS];
-    int uniqueCount = 0;
-    for(int i=0;i<recCount;i++) {
-        int alreadyPreferred = 0;
-        for(int j=0;j<user->prefCount;j++) {
-            if(recommendations[i] == user->preferredBooks[j]) {
-                alreadyPreferred = 1;
-                break;
-            }
-        }
-        if(!alreadyPreferred) {
-            // Check for uniqueness
-            int isUnique = 1;
-            for(int k=0;k<uniqueCount;k++) {
-                if(uniqueRecommendations[k] == recommendations[i]) {
-                    isUnique = 0;
-                    break;
-                }
-            }
-            if(isUnique) {
-                uniqueRecommendations[uniqueCount++] = recommendations[i];
+    // Add preferences of users with similar tastes as extra candidates
+    User* similarUsers[MAX_SIMILAR_USERS];
+    int similarCount = findSimilarUsers(user, similarUsers, MAX_SIMILAR_USERS);
+    for(int i=0;i<similarCount;i++) {
+        for(int j=0;j<similarUsers[i]->prefCount;j++) {
+            int bookIndex = similarUsers[i]->preferredBooks[j];
+            if(!visited[bookIndex]) {
+                visited[bookIndex] = 1;
+                source[bookIndex] = SOURCE_SIMILAR;
+                recommendations[recCount++] = bookIndex;
             }
         }
     }
 
+    // Remove already preferred books. Candidates are unique already: each is
+    // added once, when first visited. The filters below compact in place.
+    for(int i=0;i<user->prefCount;i++)
+        source[user->preferredBooks[i]] = SOURCE_PREFERRED;
+    int* uniqueRecommendations = recommendations;
+    int uniqueCount = 0;
+    for(int i=0;i<recCount;i++) {
+        if(source[recommendations[i]] != SOURCE_PREFERRED)
+            uniqueRecommendations[uniqueCount++] = recommendations[i];
+    }
+
     if(uniqueCount == 0) {
         printf("No recommendations available based on current preferences.\n");
+        free(scratch);
         return;
     }
 
     // Filter recommendations based on desired genre
-    int genreFilteredRecommendations[MAX_BOOKS];
+    int* genreFilteredRecommendations = recommendations;
     int genreCount = 0;
     for(int i=0;i<uniqueCount;i++) {
         if(strcmp(books[uniqueRecommendations[i]].genre, desiredGenre) == 0) {
@@ -635,11 +1449,12 @@ void recommendBooks(User* user, Graph* graph) {
 
     if(genreCount == 0) {
         printf("No recommendations found in the genre \"%s\" based on your preferences.\n", desiredGenre);
+        free(scratch);
         return;
     }
 
     // Further filter based on popularity preference
-    int finalRecommendations[MAX_BOOKS];
+    int* finalRecommendations = recommendations;
     int finalCount = 0;
     for(int i=0;i<genreCount;i++) {
         if(desiredPopularity) { // Popular
@@ -657,37 +1472,59 @@ void recommendBooks(User* user, Graph* graph) {
             printf("No popular recommendations found in the genre \"%s\" based on your preferences.\n", desiredGenre);
         else
             printf("No underrated recommendations found in the genre \"%s\" based on your preferences.\n", desiredGenre);
+        free(scratch);
         return;
     }
 
     // Sort final recommendations by popularity descending
     qsort(finalRecommendations, finalCount, sizeof(int), compare_popularity_desc);
 
+    int similarRows = 0;
+    for(int i=0;i<finalCount && i < 10;i++) {
+        if(source[finalRecommendations[i]] == SOURCE_SIMILAR)
+            similarRows++;
+    }
+    if(similarRows > 0)
+        printf("Including %d recommendation(s) from users with similar tastes.\n", similarRows);
+
     // Display recommendations
-    printf("\n--- Recommendations for %s ---\n", user->name);
-    printf("%-5s %-40s %-25s %-15s %-7s %-10s\n", "ID", "Title", "Author", "Genre", "Rating", "Popularity");
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    char title[MAX_NAME_LENGTH + 32];
+    snprintf(title, sizeof(title), "Recommendations for %s", user->name);
+    writeBookHeader(&writer, title);
     for(int i=0;i<finalCount && i < 10;i++) { // Limit to top 10 recommendations
-        printf("%-5d %-40s %-25s %-15s %-7.1f %-10d\n",
-            books[finalRecommendations[i]].id,
-            books[finalRecommendations[i]].title,
-            books[finalRecommendations[i]].author,
-            books[finalRecommendations[i]].genre,
-            books[finalRecommendations[i]].rating,
-            books[finalRecommendations[i]].popularity);
+        writeBookRow(&writer, &books[finalRecommendations[i]]);
     }
-    printf("--------------------------------------------------------------------------------------------------------------\n");
+    writeRule(&writer, BOOK_RULE, sizeof(BOOK_RULE) - 1);
+    writerFlush(&writer);
+    free(scratch);
 }
 
 // BFS function to traverse the graph and collect related books
 void bfs_graph(Graph* graph, int startId, int visited[], int recommendations[], int* recCount) {
-    int queue[MAX_BOOKS];
+    int* queue = (int*) malloc(graph->numBooks * sizeof(int));
+    char* expanded = NULL;  // Store mode: genres and authors already listed
+    if(graph->groups != NULL)
+        expanded = (char*) calloc(2 * graph->numGroups, 1);
+    if(queue == NULL || (graph->groups != NULL && expanded == NULL)) {
+        printf("Memory allocation failed!\n");
+        free(queue);
+        free(expanded);
+        return;
+    }
     int front = 0, rear = 0;
     queue[rear++] = startId;
     visited[startId] = 1;
 
     while(front < rear) {
         int current = queue[front++];
+        if(graph->groups != NULL) {
+            // Store mode: every newly queued book is a recommendation
+            int queued = rear;
+            addStoreNeighbours(graph, current, expanded, visited, queue, &rear);
+            while(queued < rear)
+                recommendations[(*recCount)++] = queue[queued++];
+            continue;
+        }
         AdjListNode* temp = graph->adjLists[current];
         while(temp != NULL) {
             int adj = temp->dest;
@@ -699,6 +1536,50 @@ void bfs_graph(Graph* graph, int startId, int visited[], int recommendations[],
             temp = temp->next;
         }
     }
+    free(queue);
+    free(expanded);
+}
+
+// Function to find the group holding a book index (store mode)
+int findBookGroup(Graph* graph, int book) {
+    int low = 0, high = graph->numGroups - 1;
+    while(low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if(graph->groups[mid].start <= book)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+// Function to queue a book's unvisited neighbours from the group table
+// (store mode). A genre or an author only needs listing once per traversal,
+// since all of its books are visited afterwards; expanded holds a flag per
+// genre (by first group) followed by a flag per author (by authorFirst).
+void addStoreNeighbours(Graph* graph, int book, char* expanded, int visited[], int queue[], int* rear) {
+    BookGroup* group = &graph->groups[findBookGroup(graph, book)];
+    if(!expanded[group->genreFirst]) {
+        expanded[group->genreFirst] = 1;
+        for(long j=group->genreStart;j<group->genreEnd;j++) {
+            if(!visited[j]) {
+                visited[j] = 1;
+                queue[(*rear)++] = j;
+            }
+        }
+    }
+    if(!expanded[graph->numGroups + group->authorFirst]) {
+        expanded[graph->numGroups + group->authorFirst] = 1;
+        for(int a=group->authorFirst;a<group->authorEnd;a++) {
+            BookGroup* other = &graph->groups[graph->byAuthor[a]];
+            for(long j=other->start;j<other->start+other->count;j++) {
+                if(!visited[j]) {
+                    visited[j] = 1;
+                    queue[(*rear)++] = j;
+                }
+            }
+        }
+    }
 }
 
 // Comparator function for qsort (descending order of popularity)
@@ -710,6 +1591,11 @@ int compare_popularity_desc(const void* a, const void* b) {
 
 // Function to free the graph's adjacency lists
 void freeGraph(Graph* graph) {
+    if(graph->groups != NULL) {
+        // The group table belongs to the store mapping
+        free(graph);
+        return;
+    }
     for(int i=0;i<graph->numBooks;i++) {
         AdjListNode* node = graph->adjLists[i];
         while(node != NULL){
@@ -721,3 +1607,608 @@ void freeGraph(Graph* graph) {
     free(graph->adjLists);
     free(graph);
 }
+
+// Function to round a size up to a whole number of pages
+long alignToPage(long size, long pageSize) {
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+// Hash of a genre and author pair (FNV-1a)
+unsigned int groupHash(const char* genre, const char* author) {
+    unsigned int h = 2166136261u;
+    for(const char* c = genre; *c != '\0'; c++) {
+        h ^= (unsigned char)*c;
+        h *= 16777619u;
+    }
+    h ^= 0xFF; // Separator, so ("ab", "c") and ("a", "bc") differ
+    h *= 16777619u;
+    for(const char* c = author; *c != '\0'; c++) {
+        h ^= (unsigned char)*c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Function to find the group of a book's genre and author, optionally
+// creating it. Returns the group index, or -1.
+int findGroup(GroupTable* table, const Book* book, int create) {
+    unsigned int mask = table->slotCount - 1;
+    unsigned int slot = groupHash(book->genre, book->author) & mask;
+    while(table->slots[slot] != 0) {
+        StoreGroup* group = &table->groups[table->slots[slot] - 1];
+        if(strcmp(group->genre, book->genre) == 0 && strcmp(group->author, book->author) == 0)
+            return table->slots[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+    if(!create)
+        return -1;
+
+    if(table->count == table->capacity) {
+        int capacity = table->capacity * 2;
+        StoreGroup* groups = (StoreGroup*) realloc(table->groups, capacity * sizeof(StoreGroup));
+        if(groups == NULL)
+            return -1;
+        table->groups = groups;
+        table->capacity = capacity;
+    }
+    StoreGroup* group = &table->groups[table->count];
+    memset(group, 0, sizeof(StoreGroup));
+    strcpy(group->genre, book->genre);
+    strcpy(group->author, book->author);
+    table->slots[slot] = ++table->count;
+
+    // Keep the table at most half full
+    if(table->count * 2 > table->slotCount) {
+        int* slots = (int*) calloc(table->slotCount * 2, sizeof(int));
+        if(slots == NULL)
+            return -1;
+        free(table->slots);
+        table->slots = slots;
+        table->slotCount *= 2;
+        rebuildGroupSlots(table);
+    }
+    return table->count - 1;
+}
+
+// Function to re-index every group after the slots or the group order change
+void rebuildGroupSlots(GroupTable* table) {
+    unsigned int mask = table->slotCount - 1;
+    memset(table->slots, 0, table->slotCount * sizeof(int));
+    for(int i=0;i<table->count;i++) {
+        unsigned int slot = groupHash(table->groups[i].genre, table->groups[i].author) & mask;
+        while(table->slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        table->slots[slot] = i + 1;
+    }
+}
+
+// Comparator function for qsort (groups by genre, then author)
+int compare_group_locality(const void* a, const void* b) {
+    const StoreGroup* groupA = (const StoreGroup*)a;
+    const StoreGroup* groupB = (const StoreGroup*)b;
+    int cmp = strcmp(groupA->genre, groupB->genre);
+    if(cmp != 0)
+        return cmp;
+    return strcmp(groupA->author, groupB->author);
+}
+
+// Comparator function for qsort (group indexes by author)
+int compare_group_author(const void* a, const void* b) {
+    int groupA = *(int*)a;
+    int groupB = *(int*)b;
+    int cmp = strcmp(authorOrderGroups[groupA].author, authorOrderGroups[groupB].author);
+    if(cmp != 0)
+        return cmp;
+    return groupA - groupB;
+}
+
+// Comparator function for qsort (ID index entries by ID, then row)
+int compare_book_id(const void* a, const void* b) {
+    const BookIdEntry* entryA = (const BookIdEntry*)a;
+    const BookIdEntry* entryB = (const BookIdEntry*)b;
+    if(entryA->id != entryB->id)
+        return entryA->id < entryB->id ? -1 : 1;
+    return entryA->index - entryB->index;
+}
+
+// Function to stream a CSV catalog into a store file without holding the
+// books in memory. Pass one counts books per (genre, author) group. Groups
+// are then ordered by genre and author, which renumbers books so graph
+// neighbours share pages and fixes every book's index up front. The graph is
+// stored as that group table: a book is linked to the rest of its genre and
+// to its author's books in other genres, so edges never need to be written.
+// Pass two places each row at its final index. The file is written next to
+// path and renamed over it when complete; with keepUsers, the users of the
+// store at path are copied into the new file first.
+int buildStore(const char* path, const char* csvPath, int keepUsers) {
+    FILE* file = fopen(csvPath, "r");
+    if(file == NULL){
+        printf("Could not open file %s\n", csvPath);
+        return 0;
+    }
+    struct stat csvStat;
+    GroupTable table;
+    table.count = 0;
+    table.capacity = 64;
+    table.slotCount = 128;
+    table.groups = (StoreGroup*) malloc(table.capacity * sizeof(StoreGroup));
+    table.slots = (int*) calloc(table.slotCount, sizeof(int));
+    int* byAuthor = NULL;
+    long total = 0;
+    char tmpPath[PATH_MAX];
+
+    int ok = fstat(fileno(file), &csvStat) == 0;
+    if(ok && snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)) {
+        printf("Store path %s is too long.\n", path);
+        ok = 0;
+    }
+    if(ok && (table.groups == NULL || table.slots == NULL)) {
+        printf("Memory allocation failed!\n");
+        ok = 0;
+    }
+    if(ok)
+        ok = countBookGroups(file, &table, &total);
+    if(ok) {
+        byAuthor = (int*) malloc(table.count * sizeof(int));
+        if(byAuthor == NULL) {
+            printf("Memory allocation failed!\n");
+            ok = 0;
+        }
+    }
+    if(ok) {
+        orderBookGroups(&table, byAuthor);
+        ok = writeStoreFile(tmpPath, file, &table, byAuthor, total, &csvStat, keepUsers ? path : NULL);
+        if(ok && rename(tmpPath, path) != 0)
+            ok = 0;
+        if(ok)
+            printf("Built book store %s: %ld books in %d groups\n", path, total, table.count);
+        else
+            unlink(tmpPath);
+    }
+
+    free(byAuthor);
+    free(table.slots);
+    free(table.groups);
+    fclose(file);
+    return ok;
+}
+
+// Function to count books per (genre, author) group (store build, pass one)
+int countBookGroups(FILE* file, GroupTable* table, long* total) {
+    char buffer[BUFFER_SIZE];
+    int line = 0;
+    *total = 0;
+    while(fgets(buffer, BUFFER_SIZE, file)){
+        line++;
+        if(line == 1)
+            continue; // Skip header
+        Book newBook;
+        if(!parseBookLine(buffer, &newBook)){
+            printf("Incomplete data at line %d. Skipping.\n", line);
+            continue;
+        }
+        int g = findGroup(table, &newBook, 1);
+        if(g < 0) {
+            printf("Memory allocation failed!\n");
+            return 0;
+        }
+        table->groups[g].count++;
+        (*total)++;
+    }
+    if(*total == 0) {
+        printf("No books loaded. Please check the CSV file.\n");
+        return 0;
+    }
+    if(*total > INT_MAX) {
+        printf("Catalog has more than %d books.\n", INT_MAX);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to order groups by genre and author, assign their book ranges,
+// and link each group to its genre range and to its author's other groups
+void orderBookGroups(GroupTable* table, int* byAuthor) {
+    StoreGroup* groups = table->groups;
+    qsort(groups, table->count, sizeof(StoreGroup), compare_group_locality);
+    rebuildGroupSlots(table);
+    long next = 0;
+    for(int g=0;g<table->count;g++) {
+        groups[g].start = next;
+        next += groups[g].count;
+    }
+    for(int g=0;g<table->count;) {
+        int end = g;
+        while(end < table->count && strcmp(groups[end].genre, groups[g].genre) == 0)
+            end++;
+        for(int k=g;k<end;k++) {
+            groups[k].genreFirst = g;
+            groups[k].genreStart = groups[g].start;
+            groups[k].genreEnd = groups[end-1].start + groups[end-1].count;
+        }
+        g = end;
+    }
+
+    for(int g=0;g<table->count;g++)
+        byAuthor[g] = g;
+    authorOrderGroups = groups;
+    qsort(byAuthor, table->count, sizeof(int), compare_group_author);
+    for(int a=0;a<table->count;) {
+        int end = a;
+        while(end < table->count && strcmp(groups[byAuthor[end]].author, groups[byAuthor[a]].author) == 0)
+            end++;
+        for(int k=a;k<end;k++) {
+            groups[byAuthor[k]].authorFirst = a;
+            groups[byAuthor[k]].authorEnd = end;
+        }
+        a = end;
+    }
+}
+
+// Function to lay out the store file, write the group table into it and
+// place every book row and ID index entry (store build, pass two). Users are
+// copied from the store at usersFrom, or start empty when it is NULL.
+int writeStoreFile(const char* path, FILE* file, GroupTable* table, int* byAuthor, long total,
+                   const struct stat* csvStat, const char* usersFrom) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.pageSize = pageSize;
+    header.bookSize = sizeof(Book);
+    header.groupSize = sizeof(BookGroup);
+    header.userSectionSize = sizeof(UserSection);
+    header.slabInts = PREF_SLAB_INTS;
+    header.userCapacity = MAX_USERS;
+    header.bookCount = total;
+    header.groupCount = table->count;
+    header.groupsOffset = alignToPage(sizeof(StoreHeader), pageSize);
+    header.byAuthorOffset = header.groupsOffset + alignToPage(table->count * sizeof(BookGroup), pageSize);
+    header.idsOffset = header.byAuthorOffset + alignToPage(table->count * sizeof(int), pageSize);
+    header.booksOffset = header.idsOffset + alignToPage(total * sizeof(BookIdEntry), pageSize);
+    header.usersOffset = header.booksOffset + alignToPage(total * sizeof(Book), pageSize);
+    header.slabsOffset = header.usersOffset + alignToPage(sizeof(UserSection), pageSize);
+    header.fileSize = header.slabsOffset + alignToPage((long)MAX_USERS * PREF_SLAB_INTS * sizeof(int), pageSize);
+    header.csvSize = csvStat->st_size;
+    header.csvMtime = csvStat->st_mtim.tv_sec * 1000000000L + csvStat->st_mtim.tv_nsec;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        return 0;
+    // Sections stay sparse until written; a new user section starts empty
+    if(ftruncate(fd, header.fileSize) != 0) {
+        close(fd);
+        return 0;
+    }
+    char* base = (char*) mmap(NULL, header.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED)
+        return 0;
+    madvise(base, header.usersOffset, MADV_SEQUENTIAL);
+    if(usersFrom != NULL && !copyStoreUsers(usersFrom, base + header.usersOffset, base + header.slabsOffset)) {
+        printf("Could not carry the users of %s over.\n", usersFrom);
+        munmap(base, header.fileSize);
+        return 0;
+    }
+
+    BookGroup* records = (BookGroup*)(base + header.groupsOffset);
+    for(int g=0;g<table->count;g++) {
+        StoreGroup* group = &table->groups[g];
+        strcpy(records[g].genre, group->genre);
+        records[g].genreFirst = group->genreFirst;
+        records[g].authorFirst = group->authorFirst;
+        records[g].authorEnd = group->authorEnd;
+        records[g].start = group->start;
+        records[g].count = group->count;
+        records[g].genreStart = group->genreStart;
+        records[g].genreEnd = group->genreEnd;
+    }
+    memcpy(base + header.byAuthorOffset, byAuthor, table->count * sizeof(int));
+
+    // Pass two: place each row at its renumbered index
+    Book* rows = (Book*)(base + header.booksOffset);
+    BookIdEntry* ids = (BookIdEntry*)(base + header.idsOffset);
+    long placed = 0;
+    char buffer[BUFFER_SIZE];
+    int line = 0;
+    int ok = 1;
+    rewind(file);
+    while(ok && fgets(buffer, BUFFER_SIZE, file)){
+        line++;
+        if(line == 1)
+            continue; // Skip header
+        Book newBook;
+        if(!parseBookLine(buffer, &newBook))
+            continue;
+        int g = findGroup(table, &newBook, 0);
+        if(g < 0 || table->groups[g].fill == table->groups[g].count) {
+            ok = 0;
+            break;
+        }
+        StoreGroup* group = &table->groups[g];
+        long index = group->start + group->fill++;
+        rows[index] = newBook;
+        ids[placed].id = newBook.id;
+        ids[placed].index = index;
+        placed++;
+    }
+    // Every group must be full too, or rows were lost between the passes
+    for(int g=0;ok && g<table->count;g++) {
+        if(table->groups[g].fill != table->groups[g].count)
+            ok = 0;
+    }
+    if(!ok) {
+        printf("Catalog changed while the store was being built.\n");
+        munmap(base, header.fileSize);
+        return 0;
+    }
+    qsort(ids, total, sizeof(BookIdEntry), compare_book_id);
+
+    memcpy(base, &header, sizeof(header));
+    ok = msync(base, header.fileSize, MS_SYNC) == 0;
+    munmap(base, header.fileSize);
+    return ok;
+}
+
+// Function to copy the user records and preference slabs of an existing
+// store into the sections of a new one
+int copyStoreUsers(const char* path, char* users, char* slabs) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return 0;
+    StoreHeader header;
+    struct stat st;
+    long slabBytes = (long)MAX_USERS * PREF_SLAB_INTS * sizeof(int);
+    int ok = fstat(fd, &st) == 0
+             && read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+             && validateStoreHeader(&header, st.st_size)
+             && pread(fd, users, sizeof(UserSection), header.usersOffset) == (ssize_t)sizeof(UserSection)
+             && pread(fd, slabs, slabBytes, header.slabsOffset) == (ssize_t)slabBytes;
+    close(fd);
+    return ok;
+}
+
+// Function to check that a store header describes this build's layout and
+// that every section fits inside the file
+int validateStoreHeader(const StoreHeader* header, long fileSize) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if(memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0
+       || header->pageSize != pageSize
+       || header->bookSize != (long)sizeof(Book)
+       || header->groupSize != (long)sizeof(BookGroup)
+       || header->userSectionSize != (long)sizeof(UserSection)
+       || header->slabInts != PREF_SLAB_INTS
+       || header->userCapacity != MAX_USERS
+       || header->fileSize != fileSize)
+        return 0;
+    if(header->bookCount <= 0 || header->bookCount > INT_MAX
+       || header->bookCount > fileSize / (long)sizeof(Book)
+       || header->groupCount <= 0 || header->groupCount > header->bookCount)
+        return 0;
+    long sections[] = {header->groupsOffset, header->byAuthorOffset, header->idsOffset,
+                       header->booksOffset, header->usersOffset, header->slabsOffset};
+    for(int i=0;i<(int)(sizeof(sections)/sizeof(sections[0]));i++) {
+        if(sections[i] % pageSize != 0 || sections[i] < (long)sizeof(StoreHeader) || sections[i] > fileSize)
+            return 0;
+    }
+    if(header->groupsOffset + header->groupCount * (long)sizeof(BookGroup) > header->byAuthorOffset
+       || header->byAuthorOffset + header->groupCount * (long)sizeof(int) > header->idsOffset
+       || header->idsOffset + header->bookCount * (long)sizeof(BookIdEntry) > header->booksOffset
+       || header->booksOffset + header->bookCount * (long)sizeof(Book) > header->usersOffset
+       || header->usersOffset + (long)sizeof(UserSection) > header->slabsOffset
+       || header->slabsOffset + (long)MAX_USERS * PREF_SLAB_INTS * (long)sizeof(int) > fileSize)
+        return 0;
+    return 1;
+}
+
+// Function to check the group table, the ID index and the book rows of a
+// mapped store before anything indexes through them. Each section is read
+// once, front to back.
+int checkStoreSections(const StoreHeader* header, const char* base) {
+    const BookGroup* groups = (const BookGroup*)(base + header->groupsOffset);
+    const int* byAuthor = (const int*)(base + header->byAuthorOffset);
+    long next = 0;
+    for(long g=0;g<header->groupCount;g++) {
+        const BookGroup* group = &groups[g];
+        // Groups tile the books in order; genre and author links stay in range
+        if(memchr(group->genre, '\0', MAX_GENRE_LENGTH) == NULL
+           || group->start != next || group->count <= 0 || group->count > header->bookCount - next
+           || group->genreFirst < 0 || group->genreFirst > g
+           || group->genreStart != groups[group->genreFirst].start
+           || group->genreEnd < group->start + group->count || group->genreEnd > header->bookCount
+           || group->authorFirst < 0 || group->authorFirst >= group->authorEnd
+           || group->authorEnd > header->groupCount)
+            return 0;
+        next += group->count;
+    }
+    if(next != header->bookCount)
+        return 0;
+    for(long g=0;g<header->groupCount;g++) {
+        if(byAuthor[g] < 0 || byAuthor[g] >= header->groupCount)
+            return 0;
+    }
+
+    const BookIdEntry* ids = (const BookIdEntry*)(base + header->idsOffset);
+    for(long i=0;i<header->bookCount;i++) {
+        if(ids[i].index < 0 || ids[i].index >= header->bookCount || (i > 0 && ids[i].id < ids[i-1].id))
+            return 0;
+    }
+
+    // Rows are printed with %s, so every string field must end inside its row
+    const Book* rows = (const Book*)(base + header->booksOffset);
+    for(long i=0;i<header->bookCount;i++) {
+        if(memchr(rows[i].title, '\0', MAX_NAME_LENGTH) == NULL
+           || memchr(rows[i].author, '\0', MAX_AUTHOR_LENGTH) == NULL
+           || memchr(rows[i].genre, '\0', MAX_GENRE_LENGTH) == NULL)
+            return 0;
+    }
+    return 1;
+}
+
+// Function to map a store file, point books, the graph and the preference
+// ID arena at it, and restore its users. Only the book sections are checked
+// up front; user slabs fault in as they are touched. Returns STORE_OPENED, or
+// why the store was not opened. A store that cannot be opened is never
+// modified.
+int openStore(const char* path, const char* csvPath, Graph** graphOut) {
+    int fd = open(path, O_RDWR);
+    if(fd < 0) {
+        if(errno == ENOENT)
+            return STORE_MISSING;
+        printf("Could not open book store %s.\n", path);
+        return STORE_UNUSABLE;
+    }
+    StoreHeader header;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)
+       || !validateStoreHeader(&header, st.st_size)) {
+        printf("Book store %s is damaged or from another build.\n", path);
+        close(fd);
+        return STORE_UNUSABLE;
+    }
+    struct stat csvStat;
+    if(stat(csvPath, &csvStat) == 0
+       && (csvStat.st_size != header.csvSize
+           || csvStat.st_mtim.tv_sec * 1000000000L + csvStat.st_mtim.tv_nsec != header.csvMtime)) {
+        printf("Book store %s is older than %s. Rebuilding it with its users.\n", path, csvPath);
+        close(fd);
+        return STORE_STALE;
+    }
+
+    // Book rows and the graph are mapped privately: popularity is derived
+    // from the restored users each session and never written back
+    long baseSize = header.usersOffset;
+    char* base = (char*) mmap(NULL, baseSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(base == MAP_FAILED) {
+        printf("Could not map book store %s.\n", path);
+        close(fd);
+        return STORE_UNUSABLE;
+    }
+    // User records and preference slabs are shared so they persist
+    long sharedSize = header.fileSize - header.usersOffset;
+    char* shared = (char*) mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, header.usersOffset);
+    close(fd);
+    if(shared == MAP_FAILED) {
+        printf("Could not map book store %s.\n", path);
+        munmap(base, baseSize);
+        return STORE_UNUSABLE;
+    }
+
+    if(!checkStoreSections(&header, base)) {
+        printf("Book store %s has damaged book sections.\n", path);
+        munmap(shared, sharedSize);
+        munmap(base, baseSize);
+        return STORE_UNUSABLE;
+    }
+
+    // The group table is read on every traversal step; a user's preferences
+    // are a single page, so readahead around it is wasted
+    madvise(base + header.groupsOffset, header.idsOffset - header.groupsOffset, MADV_WILLNEED);
+    madvise(shared + (header.slabsOffset - header.usersOffset),
+            header.fileSize - header.slabsOffset, MADV_RANDOM);
+
+    Graph* graph = (Graph*) malloc(sizeof(Graph));
+    if(graph == NULL) {
+        printf("Memory allocation failed!\n");
+        munmap(shared, sharedSize);
+        munmap(base, baseSize);
+        return STORE_UNUSABLE;
+    }
+    graph->numBooks = header.bookCount;
+    graph->adjLists = NULL;
+    graph->groups = (BookGroup*)(base + header.groupsOffset);
+    graph->byAuthor = (int*)(base + header.byAuthorOffset);
+    graph->numGroups = header.groupCount;
+
+    store.base = base;
+    store.baseSize = baseSize;
+    store.shared = shared;
+    store.sharedSize = sharedSize;
+    store.groups = graph->groups;
+    store.groupCount = graph->numGroups;
+    store.ids = (BookIdEntry*)(base + header.idsOffset);
+    store.users = (UserSection*) shared;
+    books = (Book*)(base + header.booksOffset);
+    bookCount = header.bookCount;
+    preferenceIdArena = (int*)(shared + (header.slabsOffset - header.usersOffset));
+
+    if(!restoreUsers()) {
+        printf("Book store %s has damaged user records.\n", path);
+        free(graph);
+        closeStore();
+        return STORE_UNUSABLE;
+    }
+    *graphOut = graph;
+    return STORE_OPENED;
+}
+
+// Function to insert the store's users into the hash table and LSH index.
+// Preferences are kept as book IDs, so they survive a rebuild that renumbers
+// the books; IDs no longer in the catalog are dropped. Records are checked
+// first so a damaged store restores nobody.
+int restoreUsers() {
+    UserSection* section = store.users;
+    if(section->userCount < 0 || section->userCount > MAX_USERS)
+        return 0;
+    for(int slot=0;slot<section->userCount;slot++) {
+        if(section->users[slot].prefCount < 0 || section->users[slot].prefCount > MAX_BOOKS)
+            return 0;
+    }
+    int dropped = 0;
+    for(int slot=0;slot<section->userCount;slot++) {
+        UserRecord* record = &section->users[slot];
+        User user;
+        user.id = record->id;
+        strncpy(user.name, record->name, MAX_NAME_LENGTH);
+        user.name[MAX_NAME_LENGTH-1] = '\0';
+        user.preferredBooks = preferenceSlabs + slot * PREF_SLAB_INTS;
+        user.preferredIds = preferenceIdArena + slot * PREF_SLAB_INTS;
+        user.prefCount = 0;
+        initializeSignature(&user);
+        // Re-adding compacts the ID slab in place and recounts popularity
+        for(int j=0;j<record->prefCount;j++) {
+            int bookIndex = findBookIndex(user.preferredIds[j]);
+            if(bookIndex == -1)
+                dropped++;
+            else
+                addPreferredBook(&user, bookIndex);
+        }
+        record->prefCount = user.prefCount;
+        insertUser(user);
+        userCount++;
+    }
+    if(dropped > 0)
+        printf("Dropped %d preference(s) for books no longer in the catalog.\n", dropped);
+    return 1;
+}
+
+// Function to persist a user's record in store mode (no-op in memory mode)
+void saveUserRecord(User* user) {
+    if(store.users == NULL)
+        return;
+    int slot = (user->preferredBooks - preferenceSlabs) / PREF_SLAB_INTS;
+    UserRecord* record = &store.users->users[slot];
+    record->id = user->id;
+    record->prefCount = user->prefCount;
+    strncpy(record->name, user->name, MAX_NAME_LENGTH);
+    record->name[MAX_NAME_LENGTH-1] = '\0';
+    if(slot >= store.users->userCount)
+        store.users->userCount = slot + 1;
+}
+
+// Function to unmap the store, if one is open
+void closeStore() {
+    if(store.base == NULL)
+        return;
+    munmap(store.shared, store.sharedSize);
+    munmap(store.base, store.baseSize);
+    store.base = NULL;
+    store.shared = NULL;
+    store.groups = NULL;
+    store.groupCount = 0;
+    store.ids = NULL;
+    store.users = NULL;
+    books = bookArray;
+    bookCount = 0;
+    preferenceIdArena = preferenceIdSlabs;
+}
@@ -0,0 +1,93 @@
+// Builds the in-memory graph and a store from the same books.csv and checks
+// that every book has the same neighbours in both, matched by book ID, and
+// that the store's ID index finds every book.
+// Usage (from the directory holding books.csv): store_neighbours STORE_FILE
+#define main book_rec_main
+#include "../main.c"
+#undef main
+
+// Comparator function for qsort (ascending integers)
+int compare_int(const void* a, const void* b) {
+    int x = *(int*)a;
+    int y = *(int*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        printf("Usage: %s STORE_FILE\n", argv[0]);
+        return 1;
+    }
+
+    // Neighbour IDs of every book in the in-memory graph, sorted
+    loadBooksFromCSV("books.csv");
+    Graph* memoryGraph = createGraph(bookCount);
+    buildBookGraph(memoryGraph);
+    int memoryCount = bookCount;
+    int* memoryIds = (int*) malloc(memoryCount * sizeof(int));
+    long* memoryStart = (long*) malloc((memoryCount + 1) * sizeof(long));
+    int* memoryNeighbours = (int*) malloc((long)memoryCount * memoryCount * sizeof(int));
+    long pos = 0;
+    for(int i=0;i<memoryCount;i++) {
+        memoryIds[i] = books[i].id;
+        memoryStart[i] = pos;
+        for(AdjListNode* node = memoryGraph->adjLists[i]; node != NULL; node = node->next)
+            memoryNeighbours[pos++] = books[node->dest].id;
+        qsort(memoryNeighbours + memoryStart[i], pos - memoryStart[i], sizeof(int), compare_int);
+    }
+    memoryStart[memoryCount] = pos;
+    freeGraph(memoryGraph);
+    bookCount = 0;
+
+    Graph* storeGraph = NULL;
+    if(!buildStore(argv[1], "books.csv", 0) || openStore(argv[1], "books.csv", &storeGraph) != STORE_OPENED) {
+        printf("Could not build and open %s\n", argv[1]);
+        return 1;
+    }
+    if(bookCount != memoryCount) {
+        printf("Store has %d books, memory has %d\n", bookCount, memoryCount);
+        return 1;
+    }
+
+    // One expansion from a fresh traversal state queues exactly the neighbours
+    int* visited = (int*) malloc(bookCount * sizeof(int));
+    int* queue = (int*) malloc(bookCount * sizeof(int));
+    char* expanded = (char*) malloc(2 * storeGraph->numGroups);
+    int mismatches = 0;
+    for(int b=0;b<bookCount;b++) {
+        memset(visited, 0, bookCount * sizeof(int));
+        memset(expanded, 0, 2 * storeGraph->numGroups);
+        visited[b] = 1;
+        int rear = 0;
+        addStoreNeighbours(storeGraph, b, expanded, visited, queue, &rear);
+        for(int q=0;q<rear;q++)
+            queue[q] = books[queue[q]].id;
+        qsort(queue, rear, sizeof(int), compare_int);
+
+        int m = 0;
+        while(m < memoryCount && memoryIds[m] != books[b].id)
+            m++;
+        if(m == memoryCount || memoryStart[m+1] - memoryStart[m] != rear
+           || memcmp(queue, memoryNeighbours + memoryStart[m], rear * sizeof(int)) != 0) {
+            printf("Book %d: neighbours differ between store and memory\n", books[b].id);
+            mismatches++;
+        }
+        if(findBookIndex(books[b].id) != b) {
+            printf("Book %d: ID index returns row %d\n", books[b].id, findBookIndex(books[b].id));
+            mismatches++;
+        }
+    }
+
+    free(expanded);
+    free(queue);
+    free(visited);
+    free(memoryNeighbours);
+    free(memoryStart);
+    free(memoryIds);
+    freeGraph(storeGraph);
+    closeStore();
+    if(mismatches > 0)
+        return 1;
+    printf("All %d neighbour sets match\n", memoryCount);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#!/bin/sh
+# Checks the out-of-core store against the in-memory program: graph
+# neighbour sets must match book for book, users must survive restarts and
+# rebuilds after books.csv changes, and truncated or corrupted stores must
+# be refused without being modified.
+# Usage: tests/store_test.sh
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -o "$WORK/book_rec_system" "$ROOT/main.c"
+gcc -O2 -o "$WORK/store_neighbours" "$ROOT/tests/store_neighbours.c"
+cd "$WORK"
+
+failures=0
+fail() {
+    echo "$1"
+    failures=$((failures + 1))
+}
+
+# Shuffled, non-contiguous IDs so the store's renumbering is visible
+awk 'BEGIN {
+    srand(28)
+    split("Fiction Fantasy SciFi Mystery Horror Romance History Poetry", genres, " ")
+    print "ID,Title,Author,Genre,Rating"
+    for(i = 1; i <= 1000; i++) {
+        id = (i * 7919) % 10007
+        printf "%d,Title %d,Author %d,%s,%.1f\n", id, id, int(rand() * 150), genres[int(rand() * 8) + 1], rand() * 5
+    }
+}' > books.csv
+first=$(sed -n 2p books.csv | cut -d, -f1)
+second=$(sed -n 3p books.csv | cut -d, -f1)
+third=$(sed -n 4p books.csv | cut -d, -f1)
+
+# Graph: store neighbours equal in-memory neighbours
+if ! ./store_neighbours neighbours.store > neighbours.txt; then
+    cat neighbours.txt
+    fail "store graph differs from the in-memory graph"
+fi
+
+# Users: list them with the TSV writer so stdout holds only the listing
+list_users() {
+    printf '3\n8\n' | ./book_rec_system --store books.store --format tsv 2> list_err.txt
+}
+
+printf '2\n1\nAnn\n1\n%s\n1\n%s\n0\n2\n2\nBob\n1\n%s\n0\n8\n' "$first" "$second" "$first" \
+    | ./book_rec_system --store books.store > /dev/null
+printf '7\n2\n%s\n8\n' "$third" | ./book_rec_system --store books.store > /dev/null
+printf 'id\tname\tpreferred_books\n1\tAnn\t%s,%s\n2\tBob\t%s,%s\n' "$first" "$second" "$first" "$third" > expected_users.txt
+list_users > actual_users.txt
+if ! cmp -s expected_users.txt actual_users.txt; then
+    fail "users were not restored from the store"
+fi
+
+# A changed books.csv rebuilds the store and keeps the users
+touch books.csv
+list_users > actual_users.txt
+if ! grep -q "Rebuilding it with its users" list_err.txt || ! cmp -s expected_users.txt actual_users.txt; then
+    fail "users were lost when the store was rebuilt"
+fi
+
+# Preferences for books removed from books.csv are dropped, the rest kept
+grep -v "^$second," books.csv > books.tmp
+mv books.tmp books.csv
+printf 'id\tname\tpreferred_books\n1\tAnn\t%s\n2\tBob\t%s,%s\n' "$first" "$first" "$third" > expected_users.txt
+list_users > actual_users.txt
+if ! grep -q "Dropped 1 preference" list_err.txt || ! cmp -s expected_users.txt actual_users.txt; then
+    fail "preferences were not remapped after books were removed"
+fi
+
+# Damaged stores are refused and left untouched
+header_field() {
+    # Long field after the 8-byte magic, numbered from 0 as in StoreHeader
+    od -An -t d8 -j $((8 + 8 * $1)) -N 8 books.store | tr -d ' '
+}
+groups_offset=$(header_field 8)
+books_offset=$(header_field 11)
+users_offset=$(header_field 12)
+size=$(wc -c < books.store)
+
+check_refused() {
+    cp bad.store bad.copy
+    if printf '8\n' | ./book_rec_system --store bad.store > refused.txt 2>&1; then
+        fail "$1: store was accepted"
+    elif ! cmp -s bad.store bad.copy || [ -e bad.store.tmp ]; then
+        fail "$1: store was modified"
+    fi
+}
+overwrite() {
+    # Overwrite $2 bytes at offset $1 with 'x'
+    head -c "$2" /dev/zero | tr '\0' x | dd of=bad.store bs=1 seek="$1" conv=notrunc 2> /dev/null
+}
+
+head -c $((size - 4096)) books.store > bad.store
+check_refused "truncated store"
+
+cp books.store bad.store
+overwrite 0 8
+check_refused "wrong magic"
+
+cp books.store bad.store
+overwrite "$groups_offset" 50
+check_refused "unterminated group genre"
+
+cp books.store bad.store
+overwrite $((books_offset + 4)) 100
+check_refused "unterminated book title"
+
+cp books.store bad.store
+overwrite "$users_offset" 4
+check_refused "user count out of range"
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "All store checks passed"
@@ -0,0 +1,82 @@
+#!/bin/sh
+# Dumps generated catalogs larger than the output buffer and compares the
+# listings byte-for-byte with printf output using the original format strings.
+# Table rows are fixed width except for two leading long titles; each offset
+# moves every later row by one byte, so the buffer flush point sweeps across
+# every field of a row.
+# Usage: tests/writer_test.sh [number of offsets]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+OFFSETS=${1:-112}
+ROWS=1000
+
+gcc -O2 -o "$WORK/book_rec_system" "$ROOT/main.c"
+cd "$WORK"
+
+failures=0
+offset=0
+while [ "$offset" -lt "$OFFSETS" ]; do
+    # Ratings are exact in float and double so awk's %.1f matches C's
+    awk -v seed="$offset" -v shift="$offset" -v rows="$ROWS" 'BEGIN {
+        srand(seed)
+        chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789"
+        split("Fiction Fantasy SciFi Mystery Horror Romance History Poetry", genres, " ")
+        print "ID,Title,Author,Genre,Rating"
+        for(i = 1; i <= rows; i++) {
+            n = int(rand() * 39)
+            if(i == 1) n = 39 + (shift < 59 ? shift : 59)
+            if(i == 2) n = 39 + (shift > 59 ? shift - 59 : 0)
+            title = "T"
+            for(j = 0; j < n; j++) title = title substr(chars, int(rand() * length(chars)) + 1, 1)
+            author = "A"; n = int(rand() * 24)
+            for(j = 0; j < n; j++) author = author substr(chars, int(rand() * length(chars)) + 1, 1)
+            if(rand() < 0.5) rating = int(rand() * 41) / 8
+            else rating = int(rand() * 51) / 10
+            printf "%d,%s,%s,%s,%s\n", i, title, author, genres[int(rand() * 8) + 1], rating
+        }
+    }' > books.csv
+
+    awk -F, 'NR == 1 {
+        printf "--- All Books ---\n"
+        printf "%-5s %-40s %-25s %-15s %-7s %-10s\n", "ID", "Title", "Author", "Genre", "Rating", "Popularity"
+        rule = "--------------------------------------------------------------------------------------------------------------"
+        print rule
+        next
+    }
+    { printf "%-5d %-40s %-25s %-15s %-7.1f %-10d\n", $1, $2, $3, $4, $5, 0 }
+    END { print rule }' books.csv > expected_table.txt
+
+    awk -F, 'NR == 1 { print "id\ttitle\tauthor\tgenre\trating\tpopularity"; next }
+    { printf "%d\t%s\t%s\t%s\t%.1f\t%d\n", $1, $2, $3, $4, $5, 0 }' books.csv > expected_tsv.txt
+
+    printf '1\n8\n' | ./book_rec_system > table_out.txt
+    sed -n '/^--- All Books ---$/,$p' table_out.txt | head -n $((ROWS + 4)) > actual_table.txt
+    if ! cmp -s expected_table.txt actual_table.txt; then
+        echo "offset $offset: table listing differs"
+        failures=$((failures + 1))
+    fi
+
+    printf '1\n8\n' | ./book_rec_system --format tsv > actual_tsv.txt 2> /dev/null
+    if ! cmp -s expected_tsv.txt actual_tsv.txt; then
+        echo "offset $offset: TSV listing differs"
+        failures=$((failures + 1))
+    fi
+
+    # JSON Lines stdout must contain records only
+    printf '1\n8\n' | ./book_rec_system --format jsonl > actual_jsonl.txt 2> /dev/null
+    if ! awk -v rows="$ROWS" '!/^\{"id":[0-9]+,.*\}$/ { bad = 1 } END { exit bad || NR != rows }' actual_jsonl.txt; then
+        echo "offset $offset: JSON Lines output is not one record per line"
+        failures=$((failures + 1))
+    fi
+
+    offset=$((offset + 1))
+done
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "All writer checks passed ($OFFSETS offsets)"